@@ -16,8 +16,6 @@
 // and disable serial prints
 int debug = true;
 
-volatile int alarm_source = 0;
-
 void setup() {
 
   if (debug == true) {
@@ -54,48 +52,79 @@ void setup() {
 void loop()
 {
   // Sleep until an event is recognized
-  LowPower.sleep();
+  // (events raised while we were sending are already queued)
+  sleepUntilEvent();
 
   // if we get here it means that an event was received
 
   SigFox.begin();
 
-  if (debug == true) {
-    Serial1.println("Alarm event on sensor " + String(alarm_source));
-  }
-  delay(100);
+  // Send every queued event, so that alarms arriving in a burst are not lost
+  SigFoxEvent event;
+  while (SigFox.readEvent(event)) {
+
+    if (debug == true) {
+      Serial1.println("Alarm event on sensor " + String(event.source));
+    }
+    delay(100);
+
+    // 3 bytes (ALM) + 8 bytes (ID as String) + 1 byte (source) < 12 bytes
+    String to_be_sent = "ALM" + SigFox.ID() +  String(event.source);
+
+    SigFox.beginPacket();
+    SigFox.print(to_be_sent);
+    int ret = SigFox.endPacket();
 
-  // 3 bytes (ALM) + 8 bytes (ID as String) + 1 byte (source) < 12 bytes
-  String to_be_sent = "ALM" + SigFox.ID() +  String(alarm_source);
+    if (debug == true) {
+      if (ret > 0) {
+        Serial1.println("No transmission");
+      } else {
+        Serial1.println("Transmission ok");
+      }
 
-  SigFox.beginPacket();
-  SigFox.print(to_be_sent);
-  int ret = SigFox.endPacket();
+      Serial1.println(SigFox.status(SIGFOX));
+      Serial1.println(SigFox.status(ATMEL));
+    }
+  }
 
   // shut down module, back to standby
   SigFox.end();
 
   if (debug == true) {
-    if (ret > 0) {
-      Serial1.println("No transmission");
-    } else {
-      Serial1.println("Transmission ok");
-    }
-
-    Serial1.println(SigFox.status(SIGFOX));
-    Serial1.println(SigFox.status(ATMEL));
+    Serial1.println("Lost events: " + String(SigFox.droppedEvents()));
 
     // Loop forever if we are testing for a single event
     while (1) {};
   }
 }
 
+void sleepUntilEvent() {
+  // Interrupts are masked between the check and the sleep: an alarm arriving
+  // in between stays pending and wakes the board up as soon as it goes to sleep.
+  // LowPower.sleep() can't be used here, it needs the interrupts to run,
+  // so do what it does by hand
+  USBDevice.detach();
+  SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
+  __disable_irq();
+  while (SigFox.availableEvents() == 0) {
+    SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+    __DSB();
+    __WFI();
+    // let the handler of the wakeup source run, then check again
+    __enable_irq();
+    __disable_irq();
+  }
+  __enable_irq();
+  SysTick->CTRL |= SysTick_CTRL_TICKINT_Msk;
+  USBDevice.attach();
+}
+
 void alarmEvent1() {
-  alarm_source = 1;
+  SigFox.postEvent(1);
 }
 
 void alarmEvent2() {
-  alarm_source = 2;
+  SigFox.postEvent(2);
 }
 
 void reboot() {
@@ -22,6 +22,7 @@
 
 #include <ArduinoLowPower.h>
 #include <SigFox.h>
+#include <SigFoxScheduler.h>
 #include <Adafruit_HTU21DF.h>
 #include <Adafruit_Sensor.h>
 #include <Adafruit_BMP280.h>
@@ -59,6 +60,10 @@ typedef struct __attribute__ ((packed)) sigfox_message {
 // stub for message which will be sent
 SigfoxMessage msg;
 
+// Spreads the transmissions of many boards over the 15 minutes period,
+// so they don't all transmit at the same time after a power outage
+SigFoxScheduler scheduler;
+
 void setup() {
 
   if (oneshot == true) {
@@ -74,6 +79,9 @@ void setup() {
     reboot();
   }
 
+  // Every board gets its own slot, derived from the module ID, plus up to 1 minute of jitter
+  scheduler.begin(15 * 60 * 1000, SigFox.ID(), 60 * 1000);
+
   //Send module to standby until we need to send a message
   SigFox.end();
 
@@ -102,9 +110,17 @@ void setup() {
     tsl.enableAutoRange(true);
     tsl.setIntegrationTime(TSL2561_INTEGRATIONTIME_13MS);
   }
+
+  if (oneshot == false) {
+    // Wait for our slot before the first transmission
+    LowPower.sleep(scheduler.next(SigFox.uptime()));
+  }
 }
 
 void loop() {
+  // SigFox.uptime() also counts the time the library sleeps while sending
+  unsigned long wakeup = SigFox.uptime();
+
   // Every 15 minutes, read all the sensors and send them
   // Let's try to optimize the data format
   // Only use floats as intermediate representation, don't send them directly
@@ -161,8 +177,8 @@ void loop() {
     while (1) {}
   }
 
-  //Sleep for 15 minutes
-  LowPower.sleep(15 * 60 * 1000);
+  //Sleep until our next slot, 15 minutes after the previous one
+  LowPower.sleep(scheduler.next(SigFox.uptime() - wakeup));
 }
 
 void reboot() {
@@ -0,0 +1,26 @@
+/*
+  Minimal stand-in for the Arduino core, to build the hardware independent
+  parts of the library (SigFoxLog, SigFoxScheduler) on the host.
+*/
+
+#ifndef HOST_ARDUINO_h
+#define HOST_ARDUINO_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+class String
+{
+  public:
+
+  String(const char *str = "") : str(str) {};
+  const char * c_str() const { return str.c_str(); };
+
+  private:
+
+  std::string str;
+};
+
+#endif
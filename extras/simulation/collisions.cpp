@@ -0,0 +1,131 @@
+/*
+  Collision simulation for SigFoxScheduler
+
+  N boards power up at the same time (eg. after a power outage), then every
+  board wakes up in its slot, transmits for the air time of a 12 bytes frame
+  and goes back to sleep until the slot of the next period, using the real
+  scheduler. A frame collides when it overlaps in time with the frame of
+  another board on the same channel. The module picks a random frequency
+  for every frame: with 1 channel (the default) the result is an upper bound,
+  pass a larger number of channels to account for that spreading.
+
+  usage: collisions [boards] [period (s)] [jitter (s)] [periods] [channels]
+*/
+
+#include <SigFoxScheduler.h>
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+#define AIR_TIME    6240      // ms, 12 bytes frame sent 3 times at 100 bit/s
+#define AWAKE_TIME  9000      // ms, module boot, calibration and transmission
+
+struct Frame {
+  uint32_t channel;
+  unsigned long long start;
+  unsigned long long end;
+  bool operator<(Frame const & other) const {
+    return channel != other.channel ? channel < other.channel : start < other.start;
+  };
+};
+
+static uint32_t channels = 1;
+
+static uint32_t seed = 0x12345678;
+
+static uint32_t randomId()
+{
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+/*
+* Return the fraction of frames overlapping with another one
+*/
+static double collisions(std::vector<Frame> & frames)
+{
+  std::sort(frames.begin(), frames.end());
+  std::vector<bool> hit(frames.size(), false);
+  unsigned long long end = 0;
+  size_t last = 0;
+
+  for (size_t i = 0; i < frames.size(); i++) {
+    if (i > 0 && frames[i].channel != frames[i - 1].channel) end = 0;
+    if (i > 0 && frames[i].start < end) {
+      hit[i] = true;
+      hit[last] = true;
+    }
+    if (frames[i].end > end) {
+      end = frames[i].end;
+      last = i;
+    }
+  }
+  return (double)std::count(hit.begin(), hit.end(), true) / frames.size();
+}
+
+static double scheduled(int boards, unsigned long period, unsigned long jitter, int periods, bool consecutive)
+{
+  std::vector<Frame> frames;
+  frames.reserve((size_t)boards * periods);
+
+  for (int b = 0; b < boards; b++) {
+    uint32_t id = consecutive ? 0x001C8000UL + b : randomId();
+    SigFoxScheduler scheduler;
+    scheduler.begin(period, id, jitter);
+
+    unsigned long long wakeup = scheduler.next(0);
+    for (int p = 0; p < periods; p++) {
+      Frame frame = { randomId() % channels, wakeup, wakeup + AIR_TIME };
+      frames.push_back(frame);
+      wakeup += AWAKE_TIME + scheduler.next(AWAKE_TIME);
+    }
+  }
+  return collisions(frames);
+}
+
+static double lockstep(int boards, unsigned long period, int periods)
+{
+  // the WeatherMonitor pattern: a fixed sleep after every transmission
+  std::vector<Frame> frames;
+  for (int b = 0; b < boards; b++) {
+    for (int p = 0; p < periods; p++) {
+      unsigned long long wakeup = (unsigned long long)p * (period + AWAKE_TIME);
+      Frame frame = { randomId() % channels, wakeup, wakeup + AIR_TIME };
+      frames.push_back(frame);
+    }
+  }
+  return collisions(frames);
+}
+
+int main(int argc, char *argv[])
+{
+  int boards = argc > 1 ? atoi(argv[1]) : 1000;
+  unsigned long period = (argc > 2 ? atol(argv[2]) : 15 * 60) * 1000UL;
+  unsigned long jitter = (argc > 3 ? atol(argv[3]) : 60) * 1000UL;
+  int periods = argc > 4 ? atoi(argv[4]) : 96;
+  channels = argc > 5 ? atol(argv[5]) : 1;
+
+  if (boards < 2 || period == 0 || periods < 1 || channels < 1) {
+    printf("usage: collisions [boards] [period (s)] [jitter (s)] [periods] [channels]\n");
+    return 1;
+  }
+
+  // two boards in the same period overlap with probability 2 * AIR_TIME / period
+  double pair = 2.0 * AIR_TIME / period / channels;
+  if (pair > 1) pair = 1;
+  double uniform = 1;
+  for (int b = 1; b < boards; b++) {
+    uniform *= 1 - pair;
+  }
+
+  printf("%d boards, period %lu s, jitter %lu s, %d periods, %lu channels\n",
+         boards, period / 1000, jitter / 1000, periods, (unsigned long)channels);
+  printf("collision probability per frame:\n");
+  printf("  fixed sleep (lockstep)   %.4f\n", lockstep(boards, period, periods));
+  printf("  scheduler, random IDs    %.4f\n", scheduled(boards, period, jitter, periods, false));
+  printf("  scheduler, serial IDs    %.4f\n", scheduled(boards, period, jitter, periods, true));
+  printf("  uniform random phases    %.4f\n", 1 - uniform);
+  return 0;
+}
@@ -0,0 +1,185 @@
+/*
+  Host tests for SigFoxLog, on top of SigFoxFileStorage
+
+  Every test starts from a blank storage file, the log is recreated
+  (as after a reset) by building a new SigFoxLog on the same file.
+*/
+
+#include <SigFoxLog.h>
+#include <stdio.h>
+
+#define SECTOR_SIZE  256
+#define SECTORS      2
+#define SLOTS        10       // 24 bytes records in a 256 bytes sector
+
+static const char *path = "test_log.bin";
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+      printf("%s:%d: %s failed\n", __FILE__, __LINE__, #cond); \
+      failures++; \
+    } \
+  } while (0)
+
+/*
+* Power fails after the first bytes of a write
+*/
+class TornStorage : public SigFoxFileStorage
+{
+  public:
+
+  TornStorage(uint32_t limit) : SigFoxFileStorage(path, SECTOR_SIZE, SECTORS), limit(limit) {};
+
+  void write(uint32_t address, const void *data, uint32_t len) {
+    if (limit < len) len = limit;
+    SigFoxFileStorage::write(address, data, len);
+  };
+
+  private:
+
+  uint32_t limit;
+};
+
+static void frame(uint8_t *data, int n)
+{
+  for (int i = 0; i < 12; i++) {
+    data[i] = n + i;
+  }
+}
+
+static int first(SigFoxLog & log, ReplayOrder order)
+{
+  uint8_t data[12];
+  if (log.peek(data, order) != 12) return -1;
+  return data[0];
+}
+
+static void testReplayOrder()
+{
+  remove(path);
+  uint8_t data[12];
+  {
+    SigFoxFileStorage storage(path, SECTOR_SIZE, SECTORS);
+    SigFoxLog log(storage);
+    CHECK(log.begin() == 0);
+    for (int i = 0; i < 5; i++) {
+      frame(data, i);
+      CHECK(log.push(data, 12));
+    }
+  }
+
+  SigFoxFileStorage storage(path, SECTOR_SIZE, SECTORS);
+  SigFoxLog log(storage);
+  CHECK(log.begin() == 5);
+  CHECK(first(log, OLDEST_FIRST) == 0);
+  CHECK(first(log, NEWEST_FIRST) == 4);
+
+  CHECK(log.pop(OLDEST_FIRST));
+  CHECK(log.pop(NEWEST_FIRST));
+
+  // the sent marks survive a reset as well
+  SigFoxLog again(storage);
+  CHECK(again.begin() == 3);
+  CHECK(first(again, OLDEST_FIRST) == 1);
+  CHECK(first(again, NEWEST_FIRST) == 3);
+}
+
+static void testInterruptedWrite()
+{
+  remove(path);
+  uint8_t data[12];
+  {
+    SigFoxFileStorage storage(path, SECTOR_SIZE, SECTORS);
+    SigFoxLog log(storage);
+    log.begin();
+    for (int i = 0; i < 3; i++) {
+      frame(data, i);
+      log.push(data, 12);
+    }
+  }
+  {
+    // seq, len and crc written, the payload is lost
+    TornStorage storage(8);
+    SigFoxLog log(storage);
+    CHECK(log.begin() == 3);
+    frame(data, 3);
+    log.push(data, 12);
+  }
+
+  SigFoxFileStorage storage(path, SECTOR_SIZE, SECTORS);
+  SigFoxLog log(storage);
+  CHECK(log.begin() == 3);
+  CHECK(first(log, NEWEST_FIRST) == 2);
+
+  // the torn record is skipped, not overwritten
+  frame(data, 4);
+  CHECK(log.push(data, 12));
+  CHECK(log.available() == 4);
+  CHECK(first(log, NEWEST_FIRST) == 4);
+
+  SigFoxLog again(storage);
+  CHECK(again.begin() == 4);
+  CHECK(first(again, OLDEST_FIRST) == 0);
+  CHECK(first(again, NEWEST_FIRST) == 4);
+}
+
+static void testWrapAround()
+{
+  remove(path);
+  uint8_t data[12];
+  int frames = SECTORS * SLOTS + 5;
+  {
+    SigFoxFileStorage storage(path, SECTOR_SIZE, SECTORS);
+    SigFoxLog log(storage);
+    log.begin();
+    for (int i = 0; i < frames; i++) {
+      frame(data, i);
+      CHECK(log.push(data, 12));
+    }
+    // entering the first sector again erased its SLOTS pending frames
+    CHECK(log.dropped() == SLOTS);
+    CHECK(log.available() == frames - SLOTS);
+    CHECK(first(log, OLDEST_FIRST) == SLOTS);
+    CHECK(first(log, NEWEST_FIRST) == frames - 1);
+  }
+
+  SigFoxFileStorage storage(path, SECTOR_SIZE, SECTORS);
+  SigFoxLog log(storage);
+  CHECK(log.begin() == frames - SLOTS);
+  CHECK(first(log, OLDEST_FIRST) == SLOTS);
+  CHECK(first(log, NEWEST_FIRST) == frames - 1);
+
+  // writing resumes after the newest record, not at the start of the storage
+  frame(data, frames);
+  CHECK(log.push(data, 12));
+  CHECK(log.dropped() == 0);
+  CHECK(first(log, OLDEST_FIRST) == SLOTS);
+  CHECK(first(log, NEWEST_FIRST) == frames);
+
+  // sent frames are not counted as dropped when their sector is erased
+  while (log.available() > 0) {
+    log.pop(OLDEST_FIRST);
+  }
+  for (int i = 0; i < SLOTS; i++) {
+    frame(data, i);
+    log.push(data, 12);
+  }
+  CHECK(log.dropped() == 0);
+  CHECK(log.available() == SLOTS);
+}
+
+int main()
+{
+  testReplayOrder();
+  testInterruptedWrite();
+  testWrapAround();
+  remove(path);
+
+  if (failures > 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
@@ -56,6 +56,17 @@ const char * sigstr[16]  =        // SIGFOX message status
 
 #define SPICONFIG   SPISettings(100000UL, MSBFIRST, SPI_MODE0)
 
+// Uplink frame: preamble and frame type (4 bytes), flags and sequence number (2),
+// ID (4), payload padded to 0, 1, 4, 8 or 12 bytes, authentication (2), CRC (2)
+#define FRAME_OVERHEAD    14
+#define FRAME_REPEAT      3         // every frame is sent 3 times
+#define EU_BITRATE        100       // bit/s, RC1
+#define US_BITRATE        600       // bit/s, RC2
+#define TX_CURRENT        33.0f     // mA, ATA8520E at 14.5 dBm
+#define TX_VOLTAGE        3.3f      // V
+#define EU_DUTY_CYCLE     1         // percent of the time on air, no limit in RC2
+#define DUTY_WINDOW       3600      // s, the duty cycle is a budget over one hour
+
 void SIGFOXClass::debug(bool const ledOFF) {
   // Enables debug via LED and Serial prints
   // Also disables greedy sleep strategy
@@ -118,21 +129,30 @@ int SIGFOXClass::begin(arduino::HardwareSPI & spi, int reset, int poweron, int i
   return begin();
 }
 
-int SIGFOXClass::send(unsigned char mess[], int len, bool rx)
+int SIGFOXClass::send(unsigned char mess[], int len, bool rx, bool calibrate)
 {
   if (len == 0) return 98;
 
+  if (trim_min > 0) len = trimLength(mess, len);
+  if (len > 12) len = 12;
+
+  // forget the previous downlink, parsePacket() must reflect this window
+  if (rx) rx_buf_len = 0;
+
   if (rx == false && len == 1 && mess[0] < 2) {
     //we can use send_bit command
-    return sendBit(mess[0]);
+    last_len = 0;
+    int ret = sendBit(mess[0]);
+    spend(airTime(0));
+    return ret;
   }
+  last_len = len;
 
   status();
 
   digitalWrite(chip_select_pin, LOW);
   delay(1);
   spi_port->beginTransaction(SPICONFIG);
-  if (len > 12) len = 12;
   int i = 0;
 
   spi_port->transfer(0x07);
@@ -142,9 +162,11 @@ int SIGFOXClass::send(unsigned char mess[], int len, bool rx)
   delay(1);
   digitalWrite(chip_select_pin, HIGH);
 
-  delay(5);
-  calibrateCrystal();
-  delay(5);
+  if (calibrate) {
+    delay(5);
+    calibrateCrystal();
+    delay(5);
+  }
 
   digitalWrite(chip_select_pin, LOW);
   delay(1);
@@ -166,10 +188,7 @@ int SIGFOXClass::send(unsigned char mess[], int len, bool rx)
 
   if (!debugging) {
 #ifdef SIGFOX_SPI
-    spi_port->end();
-    LowPower.attachInterruptWakeup(interrupt_pin, NULL, FALLING);
-    LowPower.sleep(timeout);
-    spi_port->begin();
+    standby(timeout, true);
 #endif
     if (digitalRead(interrupt_pin) == 0) {
       status();
@@ -194,6 +213,8 @@ int SIGFOXClass::send(unsigned char mess[], int len, bool rx)
   }
 
 exit:
+  // a frame that timed out may have been sent anyway
+  spend(airTime(len));
   if (ret == 99) sig = 13;
 
   if (sig == 0 && rx) {
@@ -213,6 +234,37 @@ exit:
   return sig;
 }
 
+int SIGFOXClass::sendBatch(const uint8_t frames[][12], const int lens[], int count, int results[], long spacing)
+{
+  unsigned char mess[12];
+  bool calibrated = false;
+  int sent = 0;
+
+  for (int i = 0; i < count; i++) {
+    int len = lens[i];
+    if (len > 12) len = 12;
+    if (len > 0) memcpy(mess, frames[i], len);
+
+    if (spacing < 0) {
+      pause(dutyWait(len));
+    } else if (i > 0 && last_len >= 0) {
+      pause(spacing);
+    }
+
+    last_len = -1;
+    int ret = send(mess, len, false, !calibrated);
+    // single bit frames don't need the calibration
+    if (last_len > 0) calibrated = true;
+
+    if (tx_log != NULL && (ret == 99 || ret == 13)) {
+      tx_log->push(mess, len);
+    }
+    if (results != NULL) results[i] = ret;
+    if (ret == 0) sent++;
+  }
+  return sent;
+}
+
 int SIGFOXClass::sendBit(bool value){
   int i = 0;
   status();
@@ -231,10 +283,7 @@ int SIGFOXClass::sendBit(bool value){
 
   if (!debugging) {
 #ifdef SIGFOX_SPI
-    spi_port->end();
-    LowPower.attachInterruptWakeup(interrupt_pin, NULL, FALLING);
-    LowPower.sleep(timeout);
-    spi_port->begin();
+    standby(timeout, true);
 #endif
     if (digitalRead(interrupt_pin) == 0) {
       status();
@@ -267,6 +316,10 @@ int SIGFOXClass::beginPacket() {
 
 int SIGFOXClass::endPacket(bool rx) {
   int ret = send(tx_buffer, tx_buffer_index, rx);
+  if (tx_log != NULL && (ret == 99 || ret == 13)) {
+    // keep the frame to send it during a later wake up
+    tx_log->push(tx_buffer, tx_buffer_index);
+  }
   // invalidate the buffer
   tx_buffer_index = -1;
   return ret;
@@ -320,6 +373,126 @@ int SIGFOXClass::parsePacket() {
   return 0;
 }
 
+void SIGFOXClass::attachLog(SigFoxLog & log) {
+  tx_log = &log;
+}
+
+void SIGFOXClass::detachLog() {
+  tx_log = NULL;
+}
+
+int SIGFOXClass::replay(int budget, ReplayOrder order, long spacing) {
+  if (tx_log == NULL) return 0;
+
+  unsigned char mess[12];
+  bool calibrated = false;
+  int sent = 0;
+  for (int i = 0; i < budget; i++) {
+    int len = tx_log->peek(mess, order);
+    if (len <= 0) break;
+    if (spacing < 0) {
+      pause(dutyWait(len));
+    } else if (i > 0 && last_len >= 0) {
+      pause(spacing);
+    }
+    last_len = -1;
+    int ret = send(mess, len, false, !calibrated);
+    if (last_len > 0) calibrated = true;
+
+    if (ret == 99 || ret == 13) {
+      // still unable to send, leave the frame in the log
+      break;
+    }
+    // other errors would never succeed, drop the frame anyway
+    tx_log->pop(order);
+    if (ret == 0) sent++;
+  }
+  return sent;
+}
+
+static int payloadClass(int len) {
+  // the module pads the payload to the next size class
+  if (len <= 1) return len;
+  if (len <= 4) return 4;
+  if (len <= 8) return 8;
+  return 12;
+}
+
+void SIGFOXClass::trimPayload(int minLength, uint8_t fill) {
+  if (minLength < 1) minLength = 1;
+  trim_min = minLength;
+  trim_fill = fill;
+}
+
+void SIGFOXClass::noTrimPayload() {
+  trim_min = 0;
+}
+
+int SIGFOXClass::trimLength(unsigned char mess[], int len) {
+  int trimmed = len;
+  while (trimmed > trim_min && mess[trimmed - 1] == trim_fill) {
+    trimmed--;
+  }
+  // keep all the bytes fitting in the same size class, they are free
+  int size = payloadClass(trimmed);
+  return (size < len) ? size : len;
+}
+
+unsigned long SIGFOXClass::uptime() {
+  return millis() + slept;
+}
+
+void SIGFOXClass::setZone(Country zone) {
+  region = zone;
+}
+
+unsigned long SIGFOXClass::airTime() {
+  if (last_len < 0) return 0;
+  return airTime(last_len);
+}
+
+unsigned long SIGFOXClass::airTime(int len) {
+  return airTime(len, region);
+}
+
+unsigned long SIGFOXClass::airTime(int len, Country zone) {
+  if (len > 12) len = 12;
+  unsigned long bits = (FRAME_OVERHEAD + payloadClass(len)) * 8UL * FRAME_REPEAT;
+  return bits * 1000UL / (zone == US ? US_BITRATE : EU_BITRATE);
+}
+
+float SIGFOXClass::airEnergy() {
+  if (last_len < 0) return 0;
+  return airEnergy(last_len);
+}
+
+float SIGFOXClass::airEnergy(int len) {
+  return airEnergy(len, region);
+}
+
+float SIGFOXClass::airEnergy(int len, Country zone) {
+  return airTime(len, zone) * TX_CURRENT * TX_VOLTAGE / 1000.0f;
+}
+
+bool SIGFOXClass::postEvent(uint8_t source) {
+  SigFoxEvent event;
+  event.source = source;
+  event.time = millis();
+  return events.push(event);
+}
+
+int SIGFOXClass::availableEvents() {
+  return events.available();
+}
+
+bool SIGFOXClass::readEvent(SigFoxEvent & event) {
+  return events.pop(event);
+}
+
+unsigned long SIGFOXClass::droppedEvents() {
+  return events.dropped();
+}
+
 int SIGFOXClass::calibrateCrystal() {
   digitalWrite(chip_select_pin, LOW);
   spi_port->beginTransaction(SPICONFIG);
@@ -347,6 +520,132 @@ int SIGFOXClass::calibrateCrystal() {
   return sig;
 }
 
+void SIGFOXClass::spend(unsigned long air)
+{
+  if (region != EU) return;
+  duty_head = (duty_head + 1) % DUTY_FRAMES;
+  duty_time[duty_head] = dutyClock();
+  duty_air[duty_head] = air;
+  if (duty_count < DUTY_FRAMES) duty_count++;
+}
+
+unsigned long SIGFOXClass::dutyWait(int len)
+{
+  if (region != EU) return 0;
+
+  unsigned long budget = DUTY_WINDOW * 1000UL * EU_DUTY_CYCLE / 100;
+  unsigned long needed = airTime(len);
+  unsigned long used = 0;
+  uint32_t now = dutyClock();
+
+  // forget the frames that left the window, they are stored oldest first
+  while (duty_count > 0) {
+    int oldest = (duty_head + DUTY_FRAMES + 1 - duty_count) % DUTY_FRAMES;
+    // the clock has 1 second resolution, keep the frames 1 second longer
+    if (now - duty_time[oldest] <= DUTY_WINDOW) break;
+    duty_count--;
+  }
+  for (int i = 0; i < duty_count; i++) {
+    used += duty_air[(duty_head + DUTY_FRAMES - i) % DUTY_FRAMES];
+  }
+
+  // wait for the oldest frames to leave the window until the new one fits
+  for (int i = duty_count - 1; i >= 0 && used + needed > budget; i--) {
+    int frame = (duty_head + DUTY_FRAMES - i) % DUTY_FRAMES;
+    used -= duty_air[frame];
+    if (used + needed <= budget) {
+      return (duty_time[frame] + DUTY_WINDOW + 1 - now) * 1000UL;
+    }
+  }
+  return 0;
+}
+
+void SIGFOXClass::pause(unsigned long ms)
+{
+#ifdef SIGFOX_SPI
+  // the RTC alarm used to wake up has 1 second resolution
+  if (!debugging && ms >= 1000) {
+    standby(ms, false);
+    return;
+  }
+#endif
+  delay(ms);
+}
+
+#ifdef SIGFOX_SPI
+// Seconds since midnight of an RTC clock or alarm value (MODE2 layout)
+static uint32_t daySeconds(uint32_t value)
+{
+  RTC_MODE2_CLOCK_Type clock;
+  clock.reg = value;
+  return ((uint32_t)clock.bit.HOUR * 60 + clock.bit.MINUTE) * 60 + clock.bit.SECOND;
+}
+
+static uint32_t rtcClock()
+{
+  RTC->MODE2.READREQ.reg = RTC_READREQ_RREQ;
+  while (RTC->MODE2.STATUS.bit.SYNCBUSY) {}
+  return RTC->MODE2.CLOCK.reg;
+}
+
+// Seconds since 2000 of the RTC clock (MODE2 layout, the year counts from 2000)
+static uint32_t rtcSeconds()
+{
+  static const uint16_t monthDays[] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+  RTC_MODE2_CLOCK_Type clock;
+  clock.reg = rtcClock();
+
+  uint32_t year = clock.bit.YEAR;
+  uint32_t month = clock.bit.MONTH > 0 ? clock.bit.MONTH - 1 : 0;
+  uint32_t days = year * 365 + (year + 3) / 4 + monthDays[month % 12] +
+                  (clock.bit.DAY > 0 ? clock.bit.DAY - 1 : 0);
+  if (year % 4 == 0 && month >= 2) days++;
+  return days * 86400 + daySeconds(clock.reg);
+}
+
+void SIGFOXClass::standby(unsigned long ms, bool untilEvent)
+{
+  spi_port->end();
+  if (untilEvent) {
+    LowPower.attachInterruptWakeup(interrupt_pin, NULL, FALLING);
+  } else {
+    // the event pin must not wake us up
+    detachInterrupt(interrupt_pin);
+  }
+
+  // LowPower arms an RTC alarm (1 second resolution) and returns on any wakeup source,
+  // eg. the pins a sketch attached with LowPower.attachInterruptWakeup()
+  LowPower.sleep(ms);
+  uint32_t seconds = ms / 1000;
+  uint32_t start = (daySeconds(RTC->MODE2.Mode2Alarm[0].ALARM.reg) + 86400 - seconds) % 86400;
+
+  for (;;) {
+    uint32_t elapsed = (daySeconds(rtcClock()) + 86400 - start) % 86400;
+    if (untilEvent && digitalRead(interrupt_pin) == 0) break;
+    if (elapsed >= seconds) break;
+
+    // LowPower.sleep() can't run with interrupts masked, so the event can
+    // assert right after the check: sleep in short steps to catch it anyway
+    uint32_t remaining = seconds - elapsed;
+    if (untilEvent && remaining > 1) remaining = 1;
+    LowPower.sleep(remaining * 1000);
+  }
+
+  // millis() doesn't count the time spent sleeping
+  slept += ((daySeconds(rtcClock()) + 86400 - start) % 86400) * 1000UL;
+  spi_port->begin();
+}
+#endif
+
+uint32_t SIGFOXClass::dutyClock()
+{
+#ifdef SIGFOX_SPI
+  // the RTC keeps counting while the sketch sleeps, millis() doesn't
+  if (RTC->MODE2.CTRL.bit.ENABLE) return rtcSeconds();
+#endif
+  return uptime() / 1000;
+}
+
 int SIGFOXClass::statusCode(Protocol type)
 {
   switch (type)
@@ -599,6 +898,7 @@ void SIGFOXClass::testMode(bool on)
 
 void SIGFOXClass::setMode(Country EUMode, TxRxMode tx_rx)
 {
+  region = EUMode;
   digitalWrite(chip_select_pin, LOW);
   spi_port->beginTransaction(SPICONFIG);
   spi_port->transfer(0x11);
@@ -31,10 +31,14 @@
 
 #include <Arduino.h>
 #include <api/HardwareSPI.h>
+#include "SigFoxLog.h"
+#include "SigFoxEventQueue.h"
 
 #define BLEN  64            // Communication buffer length
 #define MAX_RX_BUF_LEN  8
 #define MAX_TX_BUF_LEN  13
+#define EVENT_QUEUE_LEN 8     // Events waiting to be sent, power of 2
+#define DUTY_FRAMES     12    // Frames remembered for the duty cycle, more don't fit in one hour
 
 
 typedef enum country {
@@ -74,6 +78,16 @@ class SIGFOXClass : public Stream
   */
   int begin(arduino::HardwareSPI & spi, int reset, int poweron, int interrupt, int chip_select, int led);
 
+  /*
+  * Send count frames (max 12 bytes each) in a single module session:
+  * the crystal is calibrated once and the MCU sleeps between the frames.
+  * By default a frame waits only when the 1% duty cycle of the EU band
+  * (36 seconds on air per hour) is spent, otherwise spacing is the pause
+  * between two frames (ms). Every frame status goes in results.
+  * Return the number of frames sent successfully
+  */
+  int sendBatch(const uint8_t frames[][12], const int lens[], int count, int results[] = NULL, long spacing = -1);
+
   // Stream compatibility (like UDP)
   int beginPacket();
   int endPacket(bool rx = false);
@@ -132,6 +146,73 @@ class SIGFOXClass : public Stream
 
   float internalTemperature();
 
+  /*
+  * Store the frames that could not be sent (timeout) in log
+  */
+  void attachLog(SigFoxLog & log);
+  void detachLog();
+  /*
+  * Send the frames stored in the log, using at most budget messages
+  * By default a frame waits only when the hourly duty cycle budget is spent,
+  * otherwise spacing is the pause between two frames (ms)
+  * Stops at the first timeout, return the number of frames sent
+  */
+  int replay(int budget, ReplayOrder order = OLDEST_FIRST, long spacing = -1);
+
+  /*
+  * Before sending, remove the trailing bytes equal to fill (keeping at least minLength bytes)
+  * when this makes the frame shorter on air
+  */
+  void trimPayload(int minLength = 1, uint8_t fill = 0);
+  /*
+  * Send the payload as written
+  */
+  void noTrimPayload();
+  /*
+  * Return the time (ms) since boot, including the time the library slept
+  * while sending (not counted by millis()), with 1 second resolution
+  */
+  unsigned long uptime();
+  /*
+  * Declare the zone the module is configured for (EU by default)
+  * Used for the air time estimates and the duty cycle
+  */
+  void setZone(Country zone);
+  /*
+  * Return the estimated time on air (ms) of a len bytes payload, 0 for a single bit
+  * Without arguments, return the estimate for the last frame sent
+  * Without zone, use the zone of the module
+  */
+  unsigned long airTime();
+  unsigned long airTime(int len);
+  unsigned long airTime(int len, Country zone);
+  /*
+  * Return the estimated transmit energy (mJ) of a len bytes payload, 0 for a single bit
+  * Without arguments, return the estimate for the last frame sent
+  * Without zone, use the zone of the module
+  */
+  float airEnergy();
+  float airEnergy(int len);
+  float airEnergy(int len, Country zone);
+
+  /*
+  * Queue an event to be sent, safe to call from an interrupt handler
+  * Return false if the queue is full
+  */
+  bool postEvent(uint8_t source);
+  /*
+  * Return the number of queued events
+  */
+  int availableEvents();
+  /*
+  * Take the oldest queued event, return false if there are none
+  */
+  bool readEvent(SigFoxEvent & event);
+  /*
+  * Return the number of events lost because the queue was full
+  */
+  unsigned long droppedEvents();
+
   /*
   *  Disable module
   */
@@ -143,7 +224,7 @@ class SIGFOXClass : public Stream
   * Send an array of bytes (max 12 bytes long) as message to SIGFOX network
   * Return SIGFOX status code
   */
-  int send(unsigned char mess[], int len = 12, bool rx = false);
+  int send(unsigned char mess[], int len = 12, bool rx = false, bool calibrate = true);
 
   /*
   * Send a single bit (0 | 1) over the Sigfox network
@@ -151,6 +232,11 @@ class SIGFOXClass : public Stream
   **/
   int sendBit(bool value);
 
+  /*
+  * Return the length to send for mess, once trimmed
+  */
+  int trimLength(unsigned char mess[], int len);
+
   /*
   * Return atm status message
   */
@@ -162,6 +248,29 @@ class SIGFOXClass : public Stream
 
   int calibrateCrystal();
 
+  /*
+  * Sleep until ms have passed or, if untilEvent, the module raises the event pin
+  * Other wakeup sources don't cut the sleep short
+  */
+  void standby(unsigned long ms, bool untilEvent);
+  /*
+  * Wait ms milliseconds, sleeping if debug is disabled
+  */
+  void pause(unsigned long ms);
+  /*
+  * Record a frame that stayed air ms on air, for the duty cycle
+  */
+  void spend(unsigned long air);
+  /*
+  * Return how long (ms) a len bytes frame must wait for the duty cycle budget
+  * of the last hour to allow it
+  */
+  unsigned long dutyWait(int len);
+  /*
+  * Return a time in seconds that keeps counting while the board sleeps
+  */
+  uint32_t dutyClock();
+
   /*
   * Test mode
   */
@@ -189,6 +298,8 @@ class SIGFOXClass : public Stream
   unsigned char rx_buffer[MAX_RX_BUF_LEN];
   unsigned char tx_buffer[MAX_TX_BUF_LEN];
   int tx_buffer_index = -1;
+  SigFoxLog *tx_log = NULL;
+  SigFoxEventQueue<EVENT_QUEUE_LEN> events;
   arduino::HardwareSPI *spi_port;
   int reset_pin;
   int poweron_pin;
@@ -196,6 +307,15 @@ class SIGFOXClass : public Stream
   int chip_select_pin;
   int led_pin;
   int rx_buf_len = 0;
+  int trim_min = 0;           // 0: trimming disabled
+  uint8_t trim_fill = 0;
+  Country region = EU;
+  unsigned long slept = 0;    // time spent in standby(), ms
+  int last_len = -1;          // payload of the last frame sent, 0 for a single bit
+  uint32_t duty_time[DUTY_FRAMES];    // dutyClock() of the frames sent in the last hour
+  uint16_t duty_air[DUTY_FRAMES];     // and their time on air, ms
+  int duty_head = 0;                  // newest frame
+  int duty_count = 0;
   bool debugging = false;
   bool no_led = false;
 };
@@ -0,0 +1,151 @@
+/*****************************************************************************/
+/*
+  Downlink planner for Arduino SigFox library.
+  Decides which uplinks should open a receive window.
+*/
+/*****************************************************************************/
+
+/*
+  Copyright (c) 2016 Arduino LLC
+
+  This software is open source software and is not owned by Atmel;
+  you can redistribute it and/or modify it under the terms of the GNU
+  Lesser General Public License as published by the Free Software Foundation;
+  either version 2.1 of the License, or (at your option) any later version.
+
+  You acknowledge that the ArduinoUNO software is distributed to you free of
+  charge on an "as is" basis and that it has not been developed to meet your
+  specific requirements. It is supplied in the hope that it will be useful but
+  WITHOUT ANY WARRANTY that its use will be uninterrupted or error-free.
+  All other conditions, warranties or other terms which might have effect
+  between the parties or be implied or incorporated into this licence or any
+  collateral contract whether by statute or otherwise are hereby excluded,
+  including the implied conditions, warranties or other terms as to
+  satisfactory quality, fitness for purpose, non-infringement or the use of
+  reasonable skill and care.
+  See the GNU Lesser General Public License for more details.
+*/
+
+
+#include "SigFoxDownlink.h"
+
+#define MAX_BACKOFF_SHIFT  4
+
+void SigFoxDownlinkPlanner::begin(unsigned long maxAge, int quota)
+{
+  if (quota > DOWNLINK_MAX_QUOTA) quota = DOWNLINK_MAX_QUOTA;
+  if (quota < 1) quota = 1;
+  if (maxAge > DOWNLINK_MAX_AGE) maxAge = DOWNLINK_MAX_AGE;
+  max_age = maxAge;
+  this->quota = quota;
+  request_count = 0;
+  request_head = 0;
+  stale = true;
+  empty_windows = 0;
+  outcomes = 0;
+  undo = false;
+}
+
+bool SigFoxDownlinkPlanner::request(unsigned long now)
+{
+  if (wait(now) > 0) return false;
+
+  // remember what is overwritten, in case the request is cancelled
+  undo_time = requests[request_head];
+  undo_last = last_request;
+  undo_count = request_count;
+  undo = true;
+
+  requests[request_head] = now;
+  request_head = (request_head + 1) % quota;
+  if (request_count < quota) request_count++;
+  last_request = now;
+  return true;
+}
+
+void SigFoxDownlinkPlanner::cancel()
+{
+  if (!undo) return;
+  request_head = (request_head + quota - 1) % quota;
+  requests[request_head] = undo_time;
+  request_count = undo_count;
+  last_request = undo_last;
+  undo = false;
+}
+
+void SigFoxDownlinkPlanner::result(bool received, unsigned long now)
+{
+  undo = false;
+  outcomes = (outcomes << 1) | (received ? 1 : 0);
+  if (received) {
+    last_data = now;
+    stale = false;
+    empty_windows = 0;
+  } else {
+    empty_windows++;
+  }
+}
+
+void SigFoxDownlinkPlanner::invalidate()
+{
+  stale = true;
+}
+
+unsigned long SigFoxDownlinkPlanner::next(unsigned long now)
+{
+  return now + wait(now);
+}
+
+int SigFoxDownlinkPlanner::remaining(unsigned long now)
+{
+  expire(now);
+  return quota - request_count;
+}
+
+uint8_t SigFoxDownlinkPlanner::history()
+{
+  return outcomes;
+}
+
+// All the times are compared as elapsed times (now - time), which stay right
+// when millis() wraps around, as long as they are shorter than 49 days
+
+unsigned long SigFoxDownlinkPlanner::wait(unsigned long now)
+{
+  unsigned long time = 0;
+
+  // the configuration is due for a refresh...
+  if (!stale) {
+    unsigned long age = now - last_data;
+    // once stale it stays so, even if the age wraps around later
+    if (age >= max_age) stale = true;
+    else time = max_age - age;
+  }
+
+  // ...but after empty windows wait longer, doubling the delay every time
+  if (empty_windows > 0) {
+    int shift = empty_windows - 1;
+    if (shift > MAX_BACKOFF_SHIFT) shift = MAX_BACKOFF_SHIFT;
+    unsigned long backoff = (DOWNLINK_DAY / quota) << shift;
+    unsigned long elapsed = now - last_request;
+    if (elapsed < backoff && backoff - elapsed > time) time = backoff - elapsed;
+  }
+
+  // ...and never exceed the daily quota
+  if (remaining(now) == 0) {
+    // the oldest request of the ring is the next one to expire
+    unsigned long elapsed = now - requests[request_head];
+    if (DOWNLINK_DAY - elapsed > time) time = DOWNLINK_DAY - elapsed;
+  }
+  return time;
+}
+
+void SigFoxDownlinkPlanner::expire(unsigned long now)
+{
+  // the ring is in chronological order, the oldest request comes first
+  while (request_count > 0) {
+    int oldest = (request_head + quota - request_count) % quota;
+    if (now - requests[oldest] < DOWNLINK_DAY) break;
+    request_count--;
+  }
+}
@@ -0,0 +1,110 @@
+/*****************************************************************************/
+/*
+  Downlink planner for Arduino SigFox library.
+  Decides which uplinks should open a receive window.
+*/
+/*****************************************************************************/
+
+/*
+ Copyright (c) 2016 Arduino LLC
+
+ This software is open source software and is not owned by Atmel;
+ you can redistribute it and/or modify it under the terms of the GNU
+ Lesser General Public License as published by the Free Software Foundation;
+ either version 2.1 of the License, or (at your option) any later version.
+
+ You acknowledge that the ArduinoUNO software is distributed to you free of
+ charge on an "as is" basis and that it has not been developed to meet your
+ specific requirements. It is supplied in the hope that it will be useful but
+ WITHOUT ANY WARRANTY that its use will be uninterrupted or error-free.
+ All other conditions, warranties or other terms which might have effect
+ between the parties or be implied or incorporated into this licence or any
+ collateral contract whether by statute or otherwise are hereby excluded,
+ including the implied conditions, warranties or other terms as to
+ satisfactory quality, fitness for purpose, non-infringement or the use of
+ reasonable skill and care.
+ See the GNU Lesser General Public License for more details.
+*/
+
+#ifndef SIGFOX_DOWNLINK_h
+#define SIGFOX_DOWNLINK_h
+
+#include <Arduino.h>
+
+#define DOWNLINK_MAX_QUOTA  8
+#define DOWNLINK_DAY        (24UL * 60 * 60 * 1000)
+#define DOWNLINK_MAX_AGE    (30 * DOWNLINK_DAY)
+
+class SigFoxDownlinkPlanner
+{
+  public:
+
+  /*
+  * Configure how old (ms) the configuration can get before asking for a new one,
+  * and how many downlinks are allowed per day (max 8)
+  * maxAge is limited to DOWNLINK_MAX_AGE (30 days)
+  * The configuration is considered stale until the first downlink is received
+  */
+  void begin(unsigned long maxAge, int quota = 4);
+  /*
+  * Call it for every uplink about to be sent at time now (ms)
+  * The time must keep counting while the board sleeps, millis() doesn't,
+  * and the uplinks must be less than 19 days apart (49 days minus DOWNLINK_MAX_AGE)
+  * Return true if the uplink should request a downlink (endPacket(true))
+  */
+  bool request(unsigned long now);
+  /*
+  * Report whether the receive window delivered data (SigFox.parsePacket())
+  */
+  void result(bool received, unsigned long now);
+  /*
+  * Call it instead of result() when the uplink failed before a receive window
+  * was opened (endPacket(true) returned an error): the request is refunded
+  */
+  void cancel();
+  /*
+  * Mark the configuration as stale, the next uplink will request a downlink
+  * (if the quota allows it)
+  */
+  void invalidate();
+  /*
+  * Return the time (ms) from which the next downlink will be requested
+  */
+  unsigned long next(unsigned long now);
+  /*
+  * Return the number of downlinks still allowed in the last 24 hours
+  */
+  int remaining(unsigned long now);
+  /*
+  * Return the outcome of the last 8 windows, bit 0 is the most recent (1: data received)
+  */
+  uint8_t history();
+
+  private:
+
+  /*
+  * Return how long (ms) to wait before the next request, 0 if it is due
+  */
+  unsigned long wait(unsigned long now);
+  /*
+  * Forget the requests older than 24 hours
+  */
+  void expire(unsigned long now);
+
+  unsigned long max_age = DOWNLINK_DAY;
+  int quota = 4;
+  unsigned long requests[DOWNLINK_MAX_QUOTA];
+  int request_count = 0;      // requests stored in the ring
+  int request_head = 0;
+  unsigned long last_data = 0;
+  bool stale = true;
+  unsigned long last_request = 0;
+  int empty_windows = 0;
+  uint8_t outcomes = 0;
+  bool undo = false;          // the last request can be cancelled
+  unsigned long undo_time;
+  unsigned long undo_last;
+  int undo_count;
+};
+
+#endif
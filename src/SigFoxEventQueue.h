@@ -0,0 +1,85 @@
+/*****************************************************************************/
+/*
+  Event queue for Arduino SigFox library.
+  Hands events over from interrupt handlers to the main loop.
+*/
+/*****************************************************************************/
+
+/*
+ Copyright (c) 2016 Arduino LLC
+
+ This software is open source software and is not owned by Atmel;
+ you can redistribute it and/or modify it under the terms of the GNU
+ Lesser General Public License as published by the Free Software Foundation;
+ either version 2.1 of the License, or (at your option) any later version.
+
+ You acknowledge that the ArduinoUNO software is distributed to you free of
+ charge on an "as is" basis and that it has not been developed to meet your
+ specific requirements. It is supplied in the hope that it will be useful but
+ WITHOUT ANY WARRANTY that its use will be uninterrupted or error-free.
+ All other conditions, warranties or other terms which might have effect
+ between the parties or be implied or incorporated into this licence or any
+ collateral contract whether by statute or otherwise are hereby excluded,
+ including the implied conditions, warranties or other terms as to
+ satisfactory quality, fitness for purpose, non-infringement or the use of
+ reasonable skill and care.
+ See the GNU Lesser General Public License for more details.
+*/
+
+#ifndef SIGFOX_EVENT_QUEUE_h
+#define SIGFOX_EVENT_QUEUE_h
+
+#include <Arduino.h>
+
+typedef struct sigfox_event {
+  uint8_t source;
+  unsigned long time;     // millis() when the event was posted
+} SigFoxEvent;
+
+/*
+* Single producer / single consumer ring, N must be a power of 2 (max 128).
+* push() may be called from one interrupt handler (or from handlers that
+* can't preempt each other), pop() from the main loop. No interrupt is disabled.
+*/
+template <uint8_t N> class SigFoxEventQueue
+{
+  static_assert(N > 0 && N <= 128 && (N & (N - 1)) == 0, "queue length must be a power of 2, max 128");
+
+  public:
+
+  bool push(SigFoxEvent const & event) {
+    uint8_t h = head;
+    if ((uint8_t)(h - tail) == N) {
+      overflows++;
+      return false;
+    }
+    events[h & (N - 1)] = event;
+    // the event must be stored before it is published
+    __asm__ __volatile__("" ::: "memory");
+    head = h + 1;
+    return true;
+  };
+
+  bool pop(SigFoxEvent & event) {
+    uint8_t t = tail;
+    if (t == head) return false;
+    event = events[t & (N - 1)];
+    // the event must be copied before the slot is released
+    __asm__ __volatile__("" ::: "memory");
+    tail = t + 1;
+    return true;
+  };
+
+  int available() { return (uint8_t)(head - tail); };
+
+  unsigned long dropped() { return overflows; };
+
+  private:
+
+  SigFoxEvent events[N];
+  volatile uint8_t head = 0;
+  volatile uint8_t tail = 0;
+  volatile unsigned long overflows = 0;
+};
+
+#endif
@@ -0,0 +1,121 @@
+/*****************************************************************************/
+/*
+  Transmit gate for Arduino SigFox library.
+  Suppresses the messages that don't carry significant changes.
+*/
+/*****************************************************************************/
+
+/*
+  Copyright (c) 2016 Arduino LLC
+
+  This software is open source software and is not owned by Atmel;
+  you can redistribute it and/or modify it under the terms of the GNU
+  Lesser General Public License as published by the Free Software Foundation;
+  either version 2.1 of the License, or (at your option) any later version.
+
+  You acknowledge that the ArduinoUNO software is distributed to you free of
+  charge on an "as is" basis and that it has not been developed to meet your
+  specific requirements. It is supplied in the hope that it will be useful but
+  WITHOUT ANY WARRANTY that its use will be uninterrupted or error-free.
+  All other conditions, warranties or other terms which might have effect
+  between the parties or be implied or incorporated into this licence or any
+  collateral contract whether by statute or otherwise are hereby excluded,
+  including the implied conditions, warranties or other terms as to
+  satisfactory quality, fitness for purpose, non-infringement or the use of
+  reasonable skill and care.
+  See the GNU Lesser General Public License for more details.
+*/
+
+
+#include "SigFoxGate.h"
+
+void SigFoxGate::begin(int channels, unsigned long heartbeat)
+{
+  if (channels > GATE_MAX_CHANNELS) channels = GATE_MAX_CHANNELS;
+  if (channels < 0) channels = 0;
+  this->channels = channels;
+  this->heartbeat = heartbeat;
+  for (int i = 0; i < channels; i++) {
+    channel[i].mode = DEADBAND;
+    channel[i].threshold = 0;
+  }
+  started = false;
+  sent_count = 0;
+  suppressed_count = 0;
+}
+
+void SigFoxGate::deadband(int ch, float band)
+{
+  if (ch < 0 || ch >= channels) return;
+  channel[ch].mode = DEADBAND;
+  channel[ch].threshold = band;
+}
+
+void SigFoxGate::swingingDoor(int ch, float deviation, float band)
+{
+  if (ch < 0 || ch >= channels) return;
+  if (band < deviation) band = deviation;
+  channel[ch].mode = SWINGING_DOOR;
+  channel[ch].threshold = deviation;
+  channel[ch].band = band;
+  channel[ch].slope_min = INFINITY;
+  channel[ch].slope_max = -INFINITY;
+}
+
+bool SigFoxGate::check(const float values[], unsigned long now)
+{
+  bool send = !started;
+  unsigned long elapsed = now - last_time;
+
+  if (heartbeat > 0 && elapsed >= heartbeat) send = true;
+
+  for (int i = 0; i < channels && !send; i++) {
+    GateChannel & c = channel[i];
+    float delta = values[i] - c.value;
+
+    if (c.mode == DEADBAND || elapsed == 0) {
+      if (fabs(delta) > c.threshold) send = true;
+      continue;
+    }
+
+    // the backend only knows the last value sent: a steady ramp keeps
+    // the door open, so bound how far the value can get from it
+    if (fabs(delta) > c.band) {
+      send = true;
+      continue;
+    }
+
+    // narrow the corridor of the lines starting from the last value sent
+    // and passing within deviation of every reading since then
+    float upper = (delta + c.threshold) / elapsed;
+    float lower = (delta - c.threshold) / elapsed;
+    if (upper < c.slope_min) c.slope_min = upper;
+    if (lower > c.slope_max) c.slope_max = lower;
+    if (c.slope_max > c.slope_min) send = true;
+  }
+
+  if (!send) {
+    suppressed_count++;
+    return false;
+  }
+
+  for (int i = 0; i < channels; i++) {
+    channel[i].value = values[i];
+    channel[i].slope_min = INFINITY;
+    channel[i].slope_max = -INFINITY;
+  }
+  last_time = now;
+  started = true;
+  sent_count++;
+  return true;
+}
+
+unsigned long SigFoxGate::sent()
+{
+  return sent_count;
+}
+
+unsigned long SigFoxGate::suppressed()
+{
+  return suppressed_count;
+}
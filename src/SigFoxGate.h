@@ -0,0 +1,92 @@
+/*****************************************************************************/
+/*
+  Transmit gate for Arduino SigFox library.
+  Suppresses the messages that don't carry significant changes.
+*/
+/*****************************************************************************/
+
+/*
+ Copyright (c) 2016 Arduino LLC
+
+ This software is open source software and is not owned by Atmel;
+ you can redistribute it and/or modify it under the terms of the GNU
+ Lesser General Public License as published by the Free Software Foundation;
+ either version 2.1 of the License, or (at your option) any later version.
+
+ You acknowledge that the ArduinoUNO software is distributed to you free of
+ charge on an "as is" basis and that it has not been developed to meet your
+ specific requirements. It is supplied in the hope that it will be useful but
+ WITHOUT ANY WARRANTY that its use will be uninterrupted or error-free.
+ All other conditions, warranties or other terms which might have effect
+ between the parties or be implied or incorporated into this licence or any
+ collateral contract whether by statute or otherwise are hereby excluded,
+ including the implied conditions, warranties or other terms as to
+ satisfactory quality, fitness for purpose, non-infringement or the use of
+ reasonable skill and care.
+ See the GNU Lesser General Public License for more details.
+*/
+
+#ifndef SIGFOX_GATE_h
+#define SIGFOX_GATE_h
+
+#include <Arduino.h>
+
+#define GATE_MAX_CHANNELS  6
+
+typedef enum gate_mode {
+  DEADBAND = 0 ,
+  SWINGING_DOOR
+} GateMode;
+
+class SigFoxGate
+{
+  public:
+
+  /*
+  * Configure the number of channels and the maximum silence (ms, 0 to disable)
+  * By default every channel sends on any change (deadband 0)
+  */
+  void begin(int channels, unsigned long heartbeat = 0);
+  /*
+  * Send when the channel moves more than band away from the last value sent
+  */
+  void deadband(int channel, float band);
+  /*
+  * Send when the values since the last one sent no longer fit
+  * a straight line within deviation (swinging door compression),
+  * or when the channel moves more than band away from the last value sent
+  * (band can't be smaller than deviation)
+  */
+  void swingingDoor(int channel, float deviation, float band);
+  /*
+  * Feed a reading of every channel taken at time now (ms)
+  * Return true if it must be sent, the values are then recorded as sent
+  */
+  bool check(const float values[], unsigned long now);
+  /*
+  * Return the number of readings sent / suppressed
+  */
+  unsigned long sent();
+  unsigned long suppressed();
+
+  private:
+
+  typedef struct gate_channel {
+    GateMode mode;
+    float threshold;
+    float band;           // swinging door: maximum distance from the last value sent
+    float value;          // last value sent
+    float slope_min;      // swinging door corridor
+    float slope_max;
+  } GateChannel;
+
+  GateChannel channel[GATE_MAX_CHANNELS];
+  int channels = 0;
+  unsigned long heartbeat = 0;
+  unsigned long last_time = 0;
+  bool started = false;
+  unsigned long sent_count = 0;
+  unsigned long suppressed_count = 0;
+};
+
+#endif
@@ -0,0 +1,370 @@
+/*****************************************************************************/
+/*
+  Store and forward log for Arduino SigFox library.
+  Keeps the frames that could not be sent in non-volatile memory.
+*/
+/*****************************************************************************/
+
+/*
+  Copyright (c) 2016 Arduino LLC
+
+  This software is open source software and is not owned by Atmel;
+  you can redistribute it and/or modify it under the terms of the GNU
+  Lesser General Public License as published by the Free Software Foundation;
+  either version 2.1 of the License, or (at your option) any later version.
+
+  You acknowledge that the ArduinoUNO software is distributed to you free of
+  charge on an "as is" basis and that it has not been developed to meet your
+  specific requirements. It is supplied in the hope that it will be useful but
+  WITHOUT ANY WARRANTY that its use will be uninterrupted or error-free.
+  All other conditions, warranties or other terms which might have effect
+  between the parties or be implied or incorporated into this licence or any
+  collateral contract whether by statute or otherwise are hereby excluded,
+  including the implied conditions, warranties or other terms as to
+  satisfactory quality, fitness for purpose, non-infringement or the use of
+  reasonable skill and care.
+  See the GNU Lesser General Public License for more details.
+*/
+
+
+#include "SigFoxLog.h"
+#include <stddef.h>
+
+#define LOG_PAYLOAD_LEN  12
+#define LOG_EMPTY        0xFFFFFFFFUL
+
+/*
+  Every frame takes one record. A record is valid only if its CRC matches,
+  so a write interrupted by a power failure is simply ignored on next begin().
+  Sent records are marked by clearing the "sent" word, which doesn't need an erase.
+  Sectors are erased only when the write position enters them, so the erases
+  rotate over the whole storage.
+*/
+typedef struct log_record {
+  uint32_t seq;
+  uint8_t len;
+  uint8_t crc;
+  uint8_t reserved[2];
+  uint8_t data[LOG_PAYLOAD_LEN];
+  uint32_t sent;
+} LogRecord;
+
+#define LOG_RECORD_LEN   sizeof(LogRecord)
+#define LOG_SENT_OFFSET  offsetof(LogRecord, sent)
+
+static uint8_t crc8(const uint8_t *data, int len, uint8_t crc)
+{
+  for (int i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+static uint8_t recordCrc(const LogRecord & record)
+{
+  uint8_t crc = crc8((const uint8_t*)&record.seq, sizeof(record.seq), 0);
+  crc = crc8(&record.len, 1, crc);
+  return crc8(record.data, record.len, crc);
+}
+
+static bool isValid(const LogRecord & record)
+{
+  return record.seq != LOG_EMPTY && record.len > 0 && record.len <= LOG_PAYLOAD_LEN &&
+         record.crc == recordCrc(record);
+}
+
+static bool isBlank(const LogRecord & record)
+{
+  const uint8_t *p = (const uint8_t*)&record;
+  for (unsigned int i = 0; i < LOG_RECORD_LEN; i++) {
+    if (p[i] != 0xFF) return false;
+  }
+  return true;
+}
+
+#if defined(ARDUINO_ARCH_SAMD) && !defined(__SAMD51__)
+
+SigFoxFlashStorage::SigFoxFlashStorage(const volatile void *area, uint32_t size) :
+  base((uint32_t)area)
+{
+  static const uint32_t pageSizes[] = { 8, 16, 32, 64, 128, 256, 512, 1024 };
+  page_size = pageSizes[NVMCTRL->PARAM.bit.PSZ];
+  row_size = page_size * 4;
+  this->size = size;
+}
+
+uint32_t SigFoxFlashStorage::sectorSize()
+{
+  return row_size;
+}
+
+uint32_t SigFoxFlashStorage::sectorCount()
+{
+  return size / row_size;
+}
+
+void SigFoxFlashStorage::read(uint32_t address, void *data, uint32_t len)
+{
+  // volatile access, the compiler must not assume the content of the const area
+  const volatile uint8_t *src = (const volatile uint8_t *)(base + address);
+  uint8_t *dst = (uint8_t *)data;
+  for (uint32_t i = 0; i < len; i++) {
+    dst[i] = src[i];
+  }
+}
+
+void SigFoxFlashStorage::write(uint32_t address, const void *data, uint32_t len)
+{
+  volatile uint32_t *dst = (volatile uint32_t *)(base + address);
+  const uint8_t *src = (const uint8_t *)data;
+  len = (len + 3) / 4;
+
+  // Disable automatic page write
+  NVMCTRL->CTRLB.bit.MANW = 1;
+
+  while (len) {
+    // Clear the page buffer, words left to 0xFF don't modify the flash content
+    NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_PBC;
+    while (NVMCTRL->INTFLAG.bit.READY == 0) {}
+
+    do {
+      uint32_t word;
+      memcpy(&word, src, 4);
+      *dst++ = word;
+      src += 4;
+      len--;
+    } while (len && ((uint32_t)dst % page_size) != 0);
+
+    NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_WP;
+    while (NVMCTRL->INTFLAG.bit.READY == 0) {}
+  }
+}
+
+void SigFoxFlashStorage::erase(uint32_t sector)
+{
+  NVMCTRL->ADDR.reg = (base + sector * row_size) / 2;
+  NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_ER;
+  while (NVMCTRL->INTFLAG.bit.READY == 0) {}
+}
+
+#endif
+
+#if !defined(ARDUINO)
+
+SigFoxFileStorage::SigFoxFileStorage(const char *path, uint32_t sectorSize, uint32_t sectorCount) :
+  sector_size(sectorSize), sectors(sectorCount)
+{
+  // keep the content of an existing file, it is the point of a non-volatile log
+  file = fopen(path, "r+b");
+  if (file == NULL) file = fopen(path, "w+b");
+  if (file == NULL) {
+    sectors = 0;
+    return;
+  }
+  fseek(file, 0, SEEK_END);
+  uint32_t size = ftell(file);
+  for (; size < sector_size * sectors; size++) {
+    fputc(0xFF, file);
+  }
+  fflush(file);
+}
+
+SigFoxFileStorage::~SigFoxFileStorage()
+{
+  if (file != NULL) fclose(file);
+}
+
+uint32_t SigFoxFileStorage::sectorSize()
+{
+  return sector_size;
+}
+
+uint32_t SigFoxFileStorage::sectorCount()
+{
+  return sectors;
+}
+
+void SigFoxFileStorage::read(uint32_t address, void *data, uint32_t len)
+{
+  fseek(file, address, SEEK_SET);
+  if (fread(data, 1, len, file) != len) memset(data, 0xFF, len);
+}
+
+void SigFoxFileStorage::write(uint32_t address, const void *data, uint32_t len)
+{
+  const uint8_t *src = (const uint8_t *)data;
+  for (uint32_t i = 0; i < len; i++) {
+    uint8_t current;
+    read(address + i, &current, 1);
+    // programming can only clear bits
+    current &= src[i];
+    fseek(file, address + i, SEEK_SET);
+    fputc(current, file);
+  }
+  fflush(file);
+}
+
+void SigFoxFileStorage::erase(uint32_t sector)
+{
+  fseek(file, sector * sector_size, SEEK_SET);
+  for (uint32_t i = 0; i < sector_size; i++) {
+    fputc(0xFF, file);
+  }
+  fflush(file);
+}
+
+#endif
+
+SigFoxLog::SigFoxLog(SigFoxStorage & storage) : storage(storage)
+{
+}
+
+int SigFoxLog::begin()
+{
+  uint32_t sectors = storage.sectorCount();
+  uint32_t slots = storage.sectorSize() / LOG_RECORD_LEN;
+  bool found = false;
+  LogRecord record;
+
+  head = 0;
+  seq = 0;
+  pending = 0;
+
+  for (uint32_t s = 0; s < sectors; s++) {
+    for (uint32_t i = 0; i < slots; i++) {
+      uint32_t address = s * storage.sectorSize() + i * LOG_RECORD_LEN;
+      storage.read(address, &record, LOG_RECORD_LEN);
+      if (!isValid(record)) continue;
+      if (record.sent == LOG_EMPTY) pending++;
+      if (!found || record.seq >= seq) {
+        // keep writing right after the newest record
+        seq = record.seq + 1;
+        head = advance(address);
+        found = true;
+      }
+    }
+  }
+  return pending;
+}
+
+bool SigFoxLog::push(const uint8_t *data, int len)
+{
+  if (len <= 0 || storage.sectorCount() == 0) return false;
+  if (len > LOG_PAYLOAD_LEN) len = LOG_PAYLOAD_LEN;
+
+  LogRecord record;
+  uint32_t sectors = storage.sectorCount();
+
+  // Find a blank slot; records left by an interrupted write are skipped
+  for (uint32_t tries = 0; ; tries++) {
+    if (head % storage.sectorSize() == 0) {
+      uint32_t sector = head / storage.sectorSize();
+      int lost = pendingIn(sector);
+      pending -= lost;
+      overwritten += lost;
+      storage.erase(sector);
+      break;
+    }
+    storage.read(head, &record, LOG_RECORD_LEN);
+    if (isBlank(record)) break;
+    if (tries > sectors * storage.sectorSize() / LOG_RECORD_LEN) return false;
+    head = advance(head);
+  }
+
+  memset(&record, 0xFF, LOG_RECORD_LEN);
+  record.seq = seq;
+  record.len = len;
+  memcpy(record.data, data, len);
+  record.crc = recordCrc(record);
+  storage.write(head, &record, LOG_SENT_OFFSET);
+
+  head = advance(head);
+  seq++;
+  pending++;
+  return true;
+}
+
+int SigFoxLog::peek(uint8_t *data, ReplayOrder order)
+{
+  uint32_t address;
+  if (!locate(order, &address)) return -1;
+
+  LogRecord record;
+  storage.read(address, &record, LOG_RECORD_LEN);
+  memcpy(data, record.data, record.len);
+  return record.len;
+}
+
+bool SigFoxLog::pop(ReplayOrder order)
+{
+  uint32_t address;
+  if (!locate(order, &address)) return false;
+
+  uint32_t sent = 0;
+  storage.write(address + LOG_SENT_OFFSET, &sent, sizeof(sent));
+  pending--;
+  return true;
+}
+
+int SigFoxLog::available()
+{
+  return pending;
+}
+
+unsigned long SigFoxLog::dropped()
+{
+  return overwritten;
+}
+
+bool SigFoxLog::locate(ReplayOrder order, uint32_t *address)
+{
+  if (pending == 0) return false;
+
+  uint32_t sectors = storage.sectorCount();
+  uint32_t slots = storage.sectorSize() / LOG_RECORD_LEN;
+  bool found = false;
+  uint32_t best = 0;
+  LogRecord record;
+
+  for (uint32_t s = 0; s < sectors; s++) {
+    for (uint32_t i = 0; i < slots; i++) {
+      uint32_t current = s * storage.sectorSize() + i * LOG_RECORD_LEN;
+      storage.read(current, &record, LOG_RECORD_LEN);
+      if (!isValid(record) || record.sent != LOG_EMPTY) continue;
+      if (!found || (order == OLDEST_FIRST ? record.seq < best : record.seq > best)) {
+        best = record.seq;
+        *address = current;
+        found = true;
+      }
+    }
+  }
+  return found;
+}
+
+int SigFoxLog::pendingIn(uint32_t sector)
+{
+  uint32_t slots = storage.sectorSize() / LOG_RECORD_LEN;
+  int count = 0;
+  LogRecord record;
+
+  for (uint32_t i = 0; i < slots; i++) {
+    storage.read(sector * storage.sectorSize() + i * LOG_RECORD_LEN, &record, LOG_RECORD_LEN);
+    if (isValid(record) && record.sent == LOG_EMPTY) count++;
+  }
+  return count;
+}
+
+uint32_t SigFoxLog::advance(uint32_t address)
+{
+  uint32_t sector = address / storage.sectorSize();
+  uint32_t next = address + LOG_RECORD_LEN;
+
+  // records don't span across sectors
+  if (next + LOG_RECORD_LEN > (sector + 1) * storage.sectorSize()) {
+    next = ((sector + 1) % storage.sectorCount()) * storage.sectorSize();
+  }
+  return next;
+}
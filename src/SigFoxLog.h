@@ -0,0 +1,173 @@
+/*****************************************************************************/
+/*
+  Store and forward log for Arduino SigFox library.
+  Keeps the frames that could not be sent in non-volatile memory.
+*/
+/*****************************************************************************/
+
+/*
+ Copyright (c) 2016 Arduino LLC
+
+ This software is open source software and is not owned by Atmel;
+ you can redistribute it and/or modify it under the terms of the GNU
+ Lesser General Public License as published by the Free Software Foundation;
+ either version 2.1 of the License, or (at your option) any later version.
+
+ You acknowledge that the ArduinoUNO software is distributed to you free of
+ charge on an "as is" basis and that it has not been developed to meet your
+ specific requirements. It is supplied in the hope that it will be useful but
+ WITHOUT ANY WARRANTY that its use will be uninterrupted or error-free.
+ All other conditions, warranties or other terms which might have effect
+ between the parties or be implied or incorporated into this licence or any
+ collateral contract whether by statute or otherwise are hereby excluded,
+ including the implied conditions, warranties or other terms as to
+ satisfactory quality, fitness for purpose, non-infringement or the use of
+ reasonable skill and care.
+ See the GNU Lesser General Public License for more details.
+*/
+
+#ifndef SIGFOX_LOG_h
+#define SIGFOX_LOG_h
+
+#include <Arduino.h>
+
+#define SIGFOX_FLASH_ROW_SIZE  256   // SAMD21 erase unit (4 pages of 64 bytes)
+
+/*
+* Reserve rows * SIGFOX_FLASH_ROW_SIZE bytes of flash to be used by SigFoxFlashStorage
+*/
+#define SIGFOX_FLASH_AREA(name, rows) \
+  __attribute__((__aligned__(SIGFOX_FLASH_ROW_SIZE))) \
+  static const uint8_t name[(rows) * SIGFOX_FLASH_ROW_SIZE] = { }
+
+typedef enum replay {
+  OLDEST_FIRST = 0 ,
+  NEWEST_FIRST
+} ReplayOrder;
+
+/*
+* Non-volatile memory backend, organized in sectors like a NOR flash:
+* erase sets a whole sector to 0xFF, write can only clear bits
+*/
+class SigFoxStorage
+{
+  public:
+
+  virtual ~SigFoxStorage() {};
+
+  /*
+  * Return the size of the smallest erasable area, in bytes
+  */
+  virtual uint32_t sectorSize() = 0;
+  /*
+  * Return the number of sectors
+  */
+  virtual uint32_t sectorCount() = 0;
+  virtual void read(uint32_t address, void *data, uint32_t len) = 0;
+  /*
+  * Address and len are multiple of 4 bytes
+  */
+  virtual void write(uint32_t address, const void *data, uint32_t len) = 0;
+  virtual void erase(uint32_t sector) = 0;
+};
+
+#if defined(ARDUINO_ARCH_SAMD) && !defined(__SAMD51__)
+/*
+* Internal flash of the SAMD21, the area must be declared with SIGFOX_FLASH_AREA
+*/
+class SigFoxFlashStorage : public SigFoxStorage
+{
+  public:
+
+  SigFoxFlashStorage(const volatile void *area, uint32_t size);
+
+  uint32_t sectorSize();
+  uint32_t sectorCount();
+  void read(uint32_t address, void *data, uint32_t len);
+  void write(uint32_t address, const void *data, uint32_t len);
+  void erase(uint32_t sector);
+
+  private:
+
+  uint32_t base;
+  uint32_t size;
+  uint32_t page_size;
+  uint32_t row_size;
+};
+#endif
+
+#if !defined(ARDUINO)
+#include <stdio.h>
+/*
+* Host stand-in for the flash, kept in a file: erase sets a sector to 0xFF,
+* write only clears bits, like the real memory. Used by the tests in extras
+*/
+class SigFoxFileStorage : public SigFoxStorage
+{
+  public:
+
+  SigFoxFileStorage(const char *path, uint32_t sectorSize, uint32_t sectorCount);
+  ~SigFoxFileStorage();
+
+  uint32_t sectorSize();
+  uint32_t sectorCount();
+  void read(uint32_t address, void *data, uint32_t len);
+  void write(uint32_t address, const void *data, uint32_t len);
+  void erase(uint32_t sector);
+
+  private:
+
+  FILE *file;
+  uint32_t sector_size;
+  uint32_t sectors;
+};
+#endif
+
+class SigFoxLog
+{
+  public:
+
+  SigFoxLog(SigFoxStorage & storage);
+
+  /*
+  * Scan the storage and recover the frames still to be sent
+  * Return the number of pending frames
+  */
+  int begin();
+  /*
+  * Append a frame (max 12 bytes long)
+  * When the storage is full the oldest sector is overwritten
+  */
+  bool push(const uint8_t *data, int len);
+  /*
+  * Copy the oldest (or newest) pending frame into data (12 bytes at least)
+  * Return its length, -1 if the log is empty
+  */
+  int peek(uint8_t *data, ReplayOrder order = OLDEST_FIRST);
+  /*
+  * Mark the oldest (or newest) pending frame as sent
+  */
+  bool pop(ReplayOrder order = OLDEST_FIRST);
+  /*
+  * Return the number of pending frames
+  */
+  int available();
+  /*
+  * Return the number of pending frames overwritten because the storage was full
+  */
+  unsigned long dropped();
+
+  private:
+
+  bool locate(ReplayOrder order, uint32_t *address);
+  int pendingIn(uint32_t sector);
+  uint32_t advance(uint32_t address);
+
+  SigFoxStorage & storage;
+  uint32_t head = 0;
+  uint32_t seq = 0;
+  int pending = 0;
+  unsigned long overwritten = 0;
+};
+
+#endif
@@ -0,0 +1,92 @@
+/*****************************************************************************/
+/*
+  Transmit slot scheduler for Arduino SigFox library.
+  Spreads the uplinks of a fleet of devices across the reporting period.
+*/
+/*****************************************************************************/
+
+/*
+  Copyright (c) 2016 Arduino LLC
+
+  This software is open source software and is not owned by Atmel;
+  you can redistribute it and/or modify it under the terms of the GNU
+  Lesser General Public License as published by the Free Software Foundation;
+  either version 2.1 of the License, or (at your option) any later version.
+
+  You acknowledge that the ArduinoUNO software is distributed to you free of
+  charge on an "as is" basis and that it has not been developed to meet your
+  specific requirements. It is supplied in the hope that it will be useful but
+  WITHOUT ANY WARRANTY that its use will be uninterrupted or error-free.
+  All other conditions, warranties or other terms which might have effect
+  between the parties or be implied or incorporated into this licence or any
+  collateral contract whether by statute or otherwise are hereby excluded,
+  including the implied conditions, warranties or other terms as to
+  satisfactory quality, fitness for purpose, non-infringement or the use of
+  reasonable skill and care.
+  See the GNU Lesser General Public License for more details.
+*/
+
+
+#include "SigFoxScheduler.h"
+
+void SigFoxScheduler::begin(unsigned long period, uint32_t id, unsigned long jitter)
+{
+  if (period == 0) period = 1;
+  if (jitter >= period) jitter = period - 1;
+  this->period = period;
+  this->jitter = jitter;
+
+  // Fibonacci hashing: consecutive IDs land far apart from each other,
+  // random IDs are spread uniformly over the period
+  uint32_t hash = id * 2654435769UL;
+  offset = ((uint64_t)hash * period) >> 32;
+
+  seed = id ^ 0x5BD1E995UL;
+  if (seed == 0) seed = 1;
+  current = 0;
+  started = false;
+}
+
+void SigFoxScheduler::begin(unsigned long period, String const & id, unsigned long jitter)
+{
+  begin(period, (uint32_t)strtoul(id.c_str(), NULL, 16), jitter);
+}
+
+unsigned long SigFoxScheduler::phase()
+{
+  return offset;
+}
+
+unsigned long SigFoxScheduler::next(unsigned long awake)
+{
+  unsigned long following = nextJitter();
+  long long sleep;
+
+  if (!started) {
+    // all the devices of the fleet boot at the same time (eg. after a power outage)
+    sleep = (long long)offset + following - awake;
+    started = true;
+  } else {
+    // last wake up happened at slot start + current
+    sleep = (long long)period + following - current - awake;
+  }
+
+  // we overslept one or more slots, skip them; a shorter sleep than the
+  // RTC alarm resolution would never wake up, so skip that slot too
+  while (sleep < SCHEDULER_MIN_SLEEP) {
+    sleep += period;
+  }
+
+  current = following;
+  return (unsigned long)sleep;
+}
+
+uint32_t SigFoxScheduler::nextJitter()
+{
+  if (jitter == 0) return 0;
+  // xorshift32, seeded from the ID so every device follows its own sequence
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed % (jitter + 1);
+}
@@ -0,0 +1,73 @@
+/*****************************************************************************/
+/*
+  Transmit slot scheduler for Arduino SigFox library.
+  Spreads the uplinks of a fleet of devices across the reporting period.
+*/
+/*****************************************************************************/
+
+/*
+ Copyright (c) 2016 Arduino LLC
+
+ This software is open source software and is not owned by Atmel;
+ you can redistribute it and/or modify it under the terms of the GNU
+ Lesser General Public License as published by the Free Software Foundation;
+ either version 2.1 of the License, or (at your option) any later version.
+
+ You acknowledge that the ArduinoUNO software is distributed to you free of
+ charge on an "as is" basis and that it has not been developed to meet your
+ specific requirements. It is supplied in the hope that it will be useful but
+ WITHOUT ANY WARRANTY that its use will be uninterrupted or error-free.
+ All other conditions, warranties or other terms which might have effect
+ between the parties or be implied or incorporated into this licence or any
+ collateral contract whether by statute or otherwise are hereby excluded,
+ including the implied conditions, warranties or other terms as to
+ satisfactory quality, fitness for purpose, non-infringement or the use of
+ reasonable skill and care.
+ See the GNU Lesser General Public License for more details.
+*/
+
+#ifndef SIGFOX_SCHEDULER_h
+#define SIGFOX_SCHEDULER_h
+
+#include <Arduino.h>
+
+#define SCHEDULER_MIN_SLEEP  1000   // ms, LowPower.sleep() wakes up with 1 second resolution
+
+class SigFoxScheduler
+{
+  public:
+
+  /*
+  * Configure the reporting period (ms), the device ID and the maximum jitter (ms)
+  * The device transmits once per period, at a phase derived from its ID
+  */
+  void begin(unsigned long period, uint32_t id, unsigned long jitter = 0);
+  /*
+  * Same as above, taking the ID as returned by SigFox.ID()
+  */
+  void begin(unsigned long period, String const & id, unsigned long jitter = 0);
+  /*
+  * Return the phase of this device inside the period (ms)
+  */
+  unsigned long phase();
+  /*
+  * Return how long to sleep (ms) to reach the next slot.
+  * awake is the time spent since the last wake up (or since boot on the first call),
+  * it is subtracted so that the wake ups don't drift away from the slot.
+  * Never less than SCHEDULER_MIN_SLEEP: a slot closer than that is skipped
+  */
+  unsigned long next(unsigned long awake = 0);
+
+  private:
+
+  uint32_t nextJitter();
+
+  unsigned long period = 0;
+  unsigned long offset = 0;
+  unsigned long jitter = 0;
+  unsigned long current = 0;    // jitter applied to the last wake up
+  uint32_t seed = 1;
+  bool started = false;
+};
+
+#endif